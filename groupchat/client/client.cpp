@@ -3,6 +3,7 @@
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <string>
+#include <map>
 #include "../shared/protocol.h"
 
 int main() {
@@ -22,9 +23,13 @@ int main() {
     std::cout << "/join <group>\n";
     std::cout << "/send <msg>\n";
     std::cout << "/history <group>\n";
+    std::cout << "/search <words|prefix*|from:<id>|page:<n>>\n";
+    std::cout << "/resume\n";
 
     int current_group = 1;   // ⭐ The active group YOU are in
 
+    std::map<uint32_t, uint32_t> last_seq;  // newest seq seen per group
+
     while (true) {
         std::string input;
         std::getline(std::cin, input);
@@ -60,6 +65,28 @@ int main() {
             pkt.group_id = stoi(input.substr(9));
         } 
         
+        else if (input.rfind("/search", 0) == 0) {
+            pkt.type = MSG_SEARCH;
+            pkt.group_id = current_group;
+            snprintf(pkt.payload, MAX_PAYLOAD_SIZE, "%s",
+                     input.size() > 8 ? input.substr(8).c_str() : "");
+        }
+
+        else if (input.rfind("/resume", 0) == 0) {
+            pkt.type = MSG_RESUME;
+
+            // "<group>:<seq> ..." for every group we have seen messages in
+            std::string resume;
+            for (auto &entry : last_seq)
+                resume += std::to_string(entry.first) + ":" +
+                          std::to_string(entry.second) + " ";
+            if (resume.empty()) {
+                std::cout << "Nothing to resume.\n";
+                continue;
+            }
+            snprintf(pkt.payload, MAX_PAYLOAD_SIZE, "%s", resume.c_str());
+        }
+
         else {
             std::cout << "Unknown command.\n";
             continue;
@@ -89,6 +116,10 @@ int main() {
                 continue;
             }
 
+            if ((response.type == SERVER_BROADCAST || response.type == MSG_HISTORY) &&
+                response.seq > last_seq[response.group_id])
+                last_seq[response.group_id] = response.seq;
+
             if (response.type == SERVER_BROADCAST) {
                 std::cout << "Message from group "
                           << response.group_id
@@ -97,6 +128,17 @@ int main() {
             else if (response.type == MSG_HISTORY) {
                 std::cout << "(history) " << response.payload << "\n";
             }
+            else if (response.type == MSG_SEARCH) {
+                std::cout << "(search) client " << response.sender_id
+                          << ": " << response.payload << "\n";
+            }
+            else if (response.type == MSG_RESUME) {
+                // Server's seq is authoritative, even if it went backwards
+                last_seq[response.group_id] = response.seq;
+                std::cout << "[resume] group " << response.group_id
+                          << " at seq " << response.seq << ": "
+                          << response.payload << "\n";
+            }
             else if (response.type == MSG_JOIN) {
                 std::cout << "[system] Joined group.\n";
             }
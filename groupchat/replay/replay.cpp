@@ -0,0 +1,239 @@
+#include <iostream>
+#include <fstream>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <algorithm>
+#include <cstdlib>
+#include "../shared/protocol.h"
+#include "../shared/capture.h"
+
+// --------------------------------------------------
+// Replay Tool
+// --------------------------------------------------
+// Drives a server with traffic recorded by `server.out --capture <file>`.
+// Each captured connection gets its own socket and packets are sent in
+// recorded order at recorded timing, scaled by `speed`.
+//
+//   replay.out <capture file> [speed] [host] [port]
+//
+//   speed 1 = real time (default), N = N times faster, 0 = no delays
+//
+// Timing starts at the first captured packet. A connection that closed in
+// the capture is only half-closed here once the server has gone quiet on
+// it for QUIET_MS, so replies to its last requests are not lost.
+
+const long QUIET_MS = 300;
+
+struct ReplayEntry {
+    CaptureRecord rec;
+    Packet pkt;
+};
+
+// One replayed connection
+struct ReplayConn {
+    int sock = -1;
+    bool closing = false;                    // closed in the capture
+    bool shut = false;                       // write side shut down
+    std::atomic<long> last_activity_us{0};   // last send or reply
+    std::thread reader;
+};
+
+std::atomic<long> bytes_received{0};
+std::chrono::steady_clock::time_point replay_start;
+
+long since_start_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - replay_start).count();
+}
+
+// Read and discard server responses so the server never blocks on us
+void drain(ReplayConn *conn) {
+    char buf[4096];
+    ssize_t n;
+    while ((n = read(conn->sock, buf, sizeof(buf))) > 0) {
+        bytes_received += n;
+        conn->last_activity_us = since_start_us();
+    }
+}
+
+// Half-close connections (closing ones, or all) the server is done with.
+// Returns how many are still open.
+size_t close_quiet(std::map<uint32_t, std::unique_ptr<ReplayConn>> &conns, bool all) {
+    size_t open = 0;
+    long now = since_start_us();
+
+    for (auto &entry : conns) {
+        ReplayConn &c = *entry.second;
+        if (c.shut)
+            continue;
+
+        if ((all || c.closing) && now - c.last_activity_us >= QUIET_MS * 1000) {
+            shutdown(c.sock, SHUT_WR);
+            c.shut = true;
+        } else {
+            open++;
+        }
+    }
+    return open;
+}
+
+int connect_to(const char *host, int port) {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+
+    sockaddr_in serv{};
+    serv.sin_family = AF_INET;
+    serv.sin_port = htons(port);
+    inet_pton(AF_INET, host, &serv.sin_addr);
+
+    if (connect(sock, (sockaddr*)&serv, sizeof(serv)) < 0) {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        std::cout << "Usage: " << argv[0]
+                  << " <capture file> [speed] [host] [port]\n";
+        return 1;
+    }
+
+    double speed = argc > 2 ? std::atof(argv[2]) : 1.0;
+    const char *host = argc > 3 ? argv[3] : "127.0.0.1";
+    int port = argc > 4 ? std::atoi(argv[4]) : 8080;
+
+    // -----------------------------
+    // LOAD CAPTURE
+    // -----------------------------
+    std::ifstream in(argv[1], std::ios::binary);
+    CaptureFileHeader header{};
+    in.read((char*)&header, sizeof(header));
+
+    if (!in || std::string(header.magic, sizeof(header.magic)) != CAPTURE_MAGIC ||
+        header.version != CAPTURE_VERSION) {
+        std::cout << "Not a capture file: " << argv[1] << "\n";
+        return 1;
+    }
+    if (header.protocol_version != PROTOCOL_VERSION) {
+        std::cout << "Capture uses protocol version "
+                  << (int)header.protocol_version << ", this build speaks "
+                  << PROTOCOL_VERSION << ".\n";
+        return 1;
+    }
+
+    std::vector<ReplayEntry> entries;
+    ReplayEntry entry{};
+    while (in.read((char*)&entry.rec, sizeof(entry.rec))) {
+        entry.pkt = Packet();
+        if (entry.rec.size > sizeof(Packet) ||
+            !in.read((char*)&entry.pkt, entry.rec.size)) {
+            std::cout << "Truncated capture, replaying "
+                      << entries.size() << " records.\n";
+            break;
+        }
+        entries.push_back(entry);
+    }
+
+    // Older captures may have records slightly out of time order; a stable
+    // sort keeps each connection's packets in the order they were read
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](const ReplayEntry &a, const ReplayEntry &b) {
+                         return a.rec.time_us < b.rec.time_us;
+                     });
+
+    // -----------------------------
+    // REPLAY
+    // -----------------------------
+    std::map<uint32_t, std::unique_ptr<ReplayConn>> conns;
+    long packets_sent = 0;
+    long max_lag_us = 0;
+
+    long first_us = entries.empty() ? 0 : (long)entries.front().rec.time_us;
+    replay_start = std::chrono::steady_clock::now();
+
+    for (auto &e : entries) {
+        if (speed > 0) {
+            auto due = replay_start + std::chrono::microseconds(
+                (long)(((long)e.rec.time_us - first_us) / speed));
+
+            // Keep closing finished connections while we wait
+            while (std::chrono::steady_clock::now() < due) {
+                close_quiet(conns, false);
+                std::this_thread::sleep_until(
+                    std::min(due, std::chrono::steady_clock::now() +
+                                      std::chrono::milliseconds(10)));
+            }
+
+            long lag = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - due).count();
+            if (lag > max_lag_us)
+                max_lag_us = lag;
+        }
+
+        close_quiet(conns, false);
+
+        auto it = conns.find(e.rec.conn_id);
+
+        // Connection closed in the capture
+        if (e.rec.size == 0) {
+            if (it != conns.end())
+                it->second->closing = true;
+            continue;
+        }
+
+        if (it == conns.end()) {
+            int sock = connect_to(host, port);
+            if (sock < 0) {
+                std::cout << "Connection failed.\n";
+                return 1;
+            }
+
+            std::unique_ptr<ReplayConn> conn(new ReplayConn);
+            conn->sock = sock;
+            conn->reader = std::thread(drain, conn.get());
+            it = conns.emplace(e.rec.conn_id, std::move(conn)).first;
+        }
+
+        ReplayConn &c = *it->second;
+        write(c.sock, &e.pkt, sizeof(e.pkt));
+        c.last_activity_us = since_start_us();
+        packets_sent++;
+    }
+
+    double elapsed = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - replay_start).count();
+
+    // Wait for the server to go quiet on every connection, then close
+    while (close_quiet(conns, true) > 0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    for (auto &entry : conns) {
+        entry.second->reader.join();
+        close(entry.second->sock);
+    }
+
+    // -----------------------------
+    // REPORT
+    // -----------------------------
+    double recorded = entries.empty() ? 0
+                                      : ((long)entries.back().rec.time_us - first_us) / 1e6;
+
+    std::cout << "==== REPLAY REPORT ====\n";
+    std::cout << "Records: " << entries.size() << "\n";
+    std::cout << "Connections: " << conns.size() << "\n";
+    std::cout << "Packets Sent: " << packets_sent << "\n";
+    std::cout << "Bytes Received: " << bytes_received << "\n";
+    std::cout << "Recorded Duration (s): " << recorded << "\n";
+    std::cout << "Replay Duration (s): " << elapsed << "\n";
+    std::cout << "Max Send Lag (us): " << max_lag_us << "\n";
+    std::cout << "=======================\n";
+    return 0;
+}
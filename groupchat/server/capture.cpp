@@ -0,0 +1,87 @@
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <vector>
+#include "../shared/capture.h"
+
+// --------------------------------------------------
+// Traffic Capture
+// --------------------------------------------------
+// Records every inbound packet (valid or not) with its arrival time and
+// connection id so the replay tool can drive a server with it later.
+// Records are buffered and written out on connection close, at most a
+// second apart while traffic flows, and on flush() (signals).
+class TrafficCapture {
+private:
+    static const size_t BUFFER_SIZE = 1 << 16;
+
+    std::mutex lock;
+    std::ofstream out;
+    std::vector<char> buffer;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point last_flush;
+
+    void write_record(uint32_t conn_id, uint32_t group_id,
+                      const void *data, uint16_t size) {
+        // Timestamp under the lock so records are written in time order
+        std::lock_guard<std::mutex> guard(lock);
+        auto now = std::chrono::steady_clock::now();
+
+        CaptureRecord rec{};
+        rec.time_us = std::chrono::duration_cast<std::chrono::microseconds>(
+            now - start).count();
+        rec.conn_id = conn_id;
+        rec.group_id = group_id;
+        rec.size = size;
+
+        out.write((const char*)&rec, sizeof(rec));
+        out.write((const char*)data, size);
+
+        if (size == 0 || now - last_flush >= std::chrono::seconds(1)) {
+            out.flush();
+            last_flush = now;
+        }
+    }
+
+public:
+    bool open(const std::string &filename) {
+        buffer.resize(BUFFER_SIZE);
+        out.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+        out.open(filename, std::ios::binary | std::ios::trunc);
+        if (!out.is_open())
+            return false;
+
+        CaptureFileHeader header{};
+        memcpy(header.magic, CAPTURE_MAGIC, sizeof(header.magic));
+        header.version = CAPTURE_VERSION;
+        header.protocol_version = PROTOCOL_VERSION;
+        out.write((const char*)&header, sizeof(header));
+
+        start = std::chrono::steady_clock::now();
+        last_flush = start;
+        return (bool)out;
+    }
+
+    void flush() {
+        std::lock_guard<std::mutex> guard(lock);
+        if (out.is_open())
+            out.flush();
+    }
+
+    bool enabled() const { return out.is_open(); }
+
+    void record_packet(uint32_t conn_id, const Packet &pkt) {
+        if (!enabled())
+            return;
+        size_t len = std::min<size_t>(pkt.payload_len, MAX_PAYLOAD_SIZE);
+        write_record(conn_id, pkt.group_id, &pkt, PACKET_HEADER_SIZE + len);
+    }
+
+    void record_close(uint32_t conn_id) {
+        if (!enabled())
+            return;
+        write_record(conn_id, 0, nullptr, 0);
+    }
+};
@@ -6,14 +6,24 @@
 #include <random>
 #include <thread>
 #include <vector>
+#include <sstream>
 #include <ctime>
+#include <csignal>
+#include <pthread.h>
+#include <sys/resource.h>
 
 #include "log_manager.cpp"
 #include "thread_pool.cpp"
+#include "fanout.cpp"
 #include "group_manager.cpp"
 #include "scheduler.cpp"
 #include "job.h"
+#include "dispatch.h"
 #include "cache.cpp"
+#include "rate_limiter.cpp"
+#include "tracer.cpp"
+#include "capture.cpp"
+#include "receive_buffer.cpp"
 
 #include "../shared/protocol.h"
 #include "../shared/utils.h"
@@ -29,9 +39,47 @@ LogManager logger("logs/chat_log.txt");
 // Global Objects
 // ---------------------------
 
+// Connections served at once (one pool thread each, started on demand)
+const size_t MAX_CLIENTS = 1024;
+
+// Admission control limits. A connection can have at most
+// ReceiveBuffer::SLOTS jobs queued, which is what holds back a single fast
+// client; these only trip when many connections are backed up at once.
+const size_t MAX_QUEUED_JOBS = MAX_CLIENTS * ReceiveBuffer::SLOTS;
+const size_t SCHEDULER_QUEUE_LIMIT = MAX_QUEUED_JOBS / 2;      // hard cap
+const size_t SHED_QUEUE_DEPTH = SCHEDULER_QUEUE_LIMIT * 3 / 4; // shed history here
+const long SHED_DISPATCH_LATENCY_US = 50000; // ...or when jobs wait > 50ms
+
+const size_t SEARCH_PAGE_SIZE = 20;
+
+// Resumes missing more than this many messages must refetch history
+const size_t RESUME_MAX_GAP = 1000;
+
+// All socket writes go through the fan-out lanes. Broadcasts to groups
+// this large hold the worker until the last member has been written.
+const size_t FANOUT_LANES = 4;
+const size_t FANOUT_LANE_CAPACITY = 4096;     // queued sends per lane
+const size_t FANOUT_WAIT_THRESHOLD = 512;
+
+// Trace 1 in N packets; `kill -USR1 <pid>` writes the trace file (and
+// flushes the capture file)
+const uint64_t TRACE_SAMPLE_EVERY = 16;
+const char *TRACE_FILE = "logs/trace.json";
+
 GroupCache cache(5);
 GroupManager groupManager;
-Scheduler scheduler;
+Scheduler scheduler(SCHEDULER_QUEUE_LIMIT);
+
+// 20 packets/sec per connection (burst 40), 200 msgs/sec per group (burst 400)
+RateLimiter limiter(40, 20, 400, 200);
+
+Tracer tracer(TRACE_SAMPLE_EVERY);
+
+// Lane threads are started in main, after the signal mask is set
+Fanout fanout(FANOUT_LANES, FANOUT_LANE_CAPACITY, FANOUT_WAIT_THRESHOLD);
+
+// Enabled with `server.out --capture <file>`
+TrafficCapture capture;
 
 // ---------------------------
 // Helper Functions
@@ -44,136 +92,259 @@ int random_burst() {
     return dist(gen);
 }
 
+// Queued on the lane that owns fd
 void send_packet(int fd, Packet &pkt) {
-    write(fd, &pkt, sizeof(pkt));
+    fanout.send(fd, pkt);
 }
 
-// ---------------------------
-// Packet Processing
-// ---------------------------
-
-void process_packet(Packet pkt, int client_socket) {
-
-
-   
-
-    switch (pkt.type) {
-
-        // ----------------------
-        // JOIN GROUP
-        // ----------------------
-        case MSG_JOIN: {
-            logger.log("Client " + std::to_string(client_socket) + 
-           " joined group " + std::to_string(pkt.group_id));
-            groupManager.join_group(pkt.group_id, client_socket);
+void send_system(int fd, const char *text) {
+    Packet out{};
+    out.type = SERVER_SYSTEM;
+    snprintf(out.payload, MAX_PAYLOAD_SIZE, "%s", text);
+    out.payload_len = strlen(out.payload);
+    out.checksum = compute_checksum(out);
+    send_packet(fd, out);
+}
 
-            Packet response{};
-            response.type = MSG_JOIN;
-            strcpy(response.payload, "Joined group.");
-            response.payload_len = strlen(response.payload);
-            response.checksum = compute_checksum(response);
-            send_packet(client_socket, response);
+// Stored message -> packet of the given type (history, search, resume)
+void send_message(int fd, uint16_t type, const Message &msg) {
+    Packet out{};
+    out.type = type;
+    out.group_id = msg.group;
+    out.sender_id = msg.sender;
+    out.seq = msg.seq;
+    snprintf(out.payload, MAX_PAYLOAD_SIZE, "%s", msg.text.c_str());
+    out.payload_len = strlen(out.payload);
+    out.checksum = compute_checksum(out);
+    send_packet(fd, out);
+}
 
-            break;
-        }
+// Queue is getting deep or jobs are waiting too long to be dispatched
+bool server_overloaded() {
+    return scheduler.depth() >= SHED_QUEUE_DEPTH ||
+           scheduler.dispatch_latency_us() > SHED_DISPATCH_LATENCY_US;
+}
 
-        // ----------------------
-        // SEND MESSAGE
-        // ----------------------
-        case MSG_SEND: {
-            // Create chat message
-            Message msg;
-            msg.sender = pkt.sender_id;
-            msg.group = pkt.group_id;
-            msg.text = pkt.payload;
-            msg.timestamp = time(nullptr);
+// ---------------------------
+// Packet Handlers
+// ---------------------------
 
-            // Store chat message (NOT join messages)
-            groupManager.store_message(pkt.group_id, msg);
+// ----------------------
+// JOIN GROUP
+// ----------------------
+template <>
+struct PacketHandler<MSG_JOIN> {
+    static void handle(const PacketView &pkt, int client_socket) {
+        logger.log("Client " + std::to_string(client_socket) +
+                   " joined group " + std::to_string(pkt.group_id()));
+        groupManager.join_group(pkt.group_id(), client_socket);
+
+        Packet response{};
+        response.type = MSG_JOIN;
+        strcpy(response.payload, "Joined group.");
+        response.payload_len = strlen(response.payload);
+        response.checksum = compute_checksum(response);
+        send_packet(client_socket, response);
+    }
+};
+
+// ----------------------
+// SEND MESSAGE
+// ----------------------
+template <>
+struct PacketHandler<MSG_SEND> {
+    static void handle(const PacketView &pkt, int) {
+        std::string_view text = pkt.text();
+
+        // Create chat message
+        Message msg;
+        msg.sender = pkt.sender_id();
+        msg.group = pkt.group_id();
+        msg.text = std::string(text);
+        msg.timestamp = time(nullptr);
+
+        uint64_t trace_id = tracer.get_current();
+        long store_start = tracer.now_us();
+
+        // Store chat message (NOT join messages) and queue the broadcast
+        // while the group is still locked, so every member gets the group's
+        // messages in seq order (resume relies on it)
+        groupManager.store_message(pkt.group_id(), msg, [&](const Message &stored) {
+            tracer.span(trace_id, "store_message", store_start, tracer.now_us());
+
+            // Same packet goes to every member, build it once
+            Packet out{};
+            out.type = SERVER_BROADCAST;
+            out.sender_id = pkt.sender_id();
+            out.group_id = pkt.group_id();
+            out.seq = stored.seq;
+            memcpy(out.payload, text.data(), text.size());
+            out.payload_len = text.size();
+            out.checksum = compute_checksum(out);
 
-            logger.log("Group " + std::to_string(pkt.group_id) + 
-           ": Client " + std::to_string(pkt.sender_id) + 
-           " sent message: " + msg.text);
+            // Broadcast to group members
+            TraceScope span(tracer, trace_id, "broadcast");
+            auto members = groupManager.get_members(pkt.group_id());
+            fanout.broadcast(members, out, [](long latency_us, bool large_group) {
+                metrics.log_fanout(latency_us, large_group);
+            });
+        });
 
-           metrics.log_message_sent();
+        logger.log("Group " + std::to_string(pkt.group_id()) +
+                   ": Client " + std::to_string(pkt.sender_id()) +
+                   " sent message: " + msg.text);
 
+        metrics.log_message_sent();
+    }
+};
 
+// ----------------------
+// HISTORY
+// ----------------------
+template <>
+struct PacketHandler<MSG_HISTORY> {
+    static void handle(const PacketView &pkt, int client_socket) {
+        std::vector<Message> history;
 
-            // Broadcast to group members
-            auto members = groupManager.get_members(pkt.group_id);
-            for (int fd : members) {
-                Packet out{};
-                out.type = SERVER_BROADCAST;
-                out.sender_id = pkt.sender_id;
-                out.group_id = pkt.group_id;
-                strncpy(out.payload, pkt.payload, 256);
-
-                out.payload_len = strlen(out.payload);
-                out.checksum = compute_checksum(out);
-                send_packet(fd, out);
+        // -------------------------
+        // CACHE LOOKUP
+        // -------------------------
+        bool hit = cache.get(pkt.group_id(), history);
+
+        if (hit) {
+            metrics.log_cache_hit();
+            logger.log("Cache HIT for group " + std::to_string(pkt.group_id()));
+        } else {
+            metrics.log_cache_miss();
+            logger.log("Cache MISS for group " + std::to_string(pkt.group_id()));
+            history = groupManager.get_history(pkt.group_id());
+            cache.put(pkt.group_id(), history);
+        }
 
-            }
+        // -------------------------
+        // SEND HISTORY MESSAGES
+        // -------------------------
+        for (auto &msg : history)
+            send_message(client_socket, MSG_HISTORY, msg);
 
-            break;
+        logger.log("Sent " + std::to_string(history.size()) +
+                   " history messages to client FD " +
+                   std::to_string(client_socket));
+    }
+};
+
+// ----------------------
+// SEARCH
+// ----------------------
+template <>
+struct PacketHandler<MSG_SEARCH> {
+    static void handle(const PacketView &pkt, int client_socket) {
+        std::string text(pkt.text());
+        SearchQuery query = SearchQuery::parse(text);
+
+        bool more = false;
+        auto results = groupManager.search(pkt.group_id(), query,
+                                           SEARCH_PAGE_SIZE, more);
+
+        for (auto &msg : results)
+            send_message(client_socket, MSG_SEARCH, msg);
+
+        std::string summary = std::to_string(results.size()) +
+                              " matches on page " + std::to_string(query.page) +
+                              (more ? ", more on page " +
+                                          std::to_string(query.page + 1)
+                                    : std::string(", no more"));
+        send_system(client_socket, summary.c_str());
+
+        logger.log("Search in group " + std::to_string(pkt.group_id()) +
+                   " for \"" + text + "\": " + summary);
+    }
+};
+
+// ----------------------
+// RESUME AFTER RECONNECT
+// ----------------------
+// Payload: "<group>:<last seq> <group>:<last seq> ...". For each group the
+// client gets the missed messages as MSG_HISTORY packets, then a MSG_RESUME
+// packet carrying the group's latest seq. If the gap is too large, or the
+// client is ahead of the server (history lost), only the MSG_RESUME packet
+// is sent, saying so, and the client should refetch. A request with no
+// valid entries gets a SERVER_SYSTEM reply so the client never waits.
+template <>
+struct PacketHandler<MSG_RESUME> {
+    static void handle(const PacketView &pkt, int client_socket) {
+        std::istringstream in{std::string(pkt.text())};
+        std::string entry;
+        int groups = 0;
+
+        while (in >> entry) {
+            size_t colon = entry.find(':');
+            if (colon == std::string::npos)
+                continue;
+
+            uint32_t group = std::strtoul(entry.c_str(), nullptr, 10);
+            uint32_t last_seq = std::strtoul(entry.c_str() + colon + 1, nullptr, 10);
+            groups++;
+
+            std::vector<Message> missed;
+            uint32_t latest = 0;
+            ResumeStatus status = groupManager.get_since(group, last_seq,
+                                                         RESUME_MAX_GAP,
+                                                         missed, latest);
+
+            const char *result = "Up to date.";
+            if (status == RESUME_GAP)
+                result = "Gap too large, fetch history.";
+            else if (status == RESUME_RESET)
+                result = "History reset, fetch history.";
+
+            for (auto &msg : missed)
+                send_message(client_socket, MSG_HISTORY, msg);
+
+            Packet done{};
+            done.type = MSG_RESUME;
+            done.group_id = group;
+            done.seq = latest;
+            strcpy(done.payload, result);
+            done.payload_len = strlen(done.payload);
+            done.checksum = compute_checksum(done);
+            send_packet(client_socket, done);
+
+            logger.log("Client FD " + std::to_string(client_socket) +
+                       " resumed group " + std::to_string(group) +
+                       " from seq " + std::to_string(last_seq) + ": " +
+                       (status == RESUME_OK ? std::to_string(missed.size()) + " missed"
+                                            : std::string(result)));
         }
 
-        // ----------------------
-        // HISTORY
-        // ----------------------
-       case MSG_HISTORY: {
-
-    std::vector<Message> history;
-
-    // -------------------------
-    // CACHE LOOKUP
-    // -------------------------
-    bool hit = cache.get(pkt.group_id, history);
-
-    if (hit) {
-        metrics.log_cache_hit();
-        logger.log("Cache HIT for group " + std::to_string(pkt.group_id));
-    } else {
-        metrics.log_cache_miss();
-        logger.log("Cache MISS for group " + std::to_string(pkt.group_id));
-        history = groupManager.get_history(pkt.group_id);
-        cache.put(pkt.group_id, history);
+        if (groups == 0)
+            send_system(client_socket, "Nothing to resume.");
     }
+};
 
-    // -------------------------
-    // SEND HISTORY MESSAGES
-    // -------------------------
-    for (auto &msg : history) {
-        Packet out{};
-        out.type = MSG_HISTORY;
-        out.group_id = msg.group;
-        out.sender_id = msg.sender;
-        snprintf(out.payload, 256, "%s", msg.text.c_str());
-        out.payload_len = strlen(out.payload);
-        out.checksum = compute_checksum(out);
-        send_packet(client_socket, out);
-
-    }
+// ---------------------------
+// Packet Processing
+// ---------------------------
 
-    logger.log("Sent " + std::to_string(history.size()) +
-               " history messages to client FD " +
-               std::to_string(client_socket));
+// Add new packet types here once their PacketHandler exists
+constexpr DispatchTable<MSG_SEND, MSG_HISTORY, MSG_JOIN, MSG_SEARCH,
+                        MSG_RESUME> dispatcher;
 
-    break;
-}
+void process_packet(const PacketView &pkt, int client_socket) {
+    HandlerFn handler = dispatcher.lookup(pkt.type());
 
+    if (handler) {
+        handler(pkt, client_socket);
+        return;
+    }
 
-        // ----------------------
-        // UNKNOWN PACKET
-        // ----------------------
-        default: {
+    // ----------------------
+    // UNKNOWN PACKET
+    // ----------------------
     Packet error{};
     error.type = MSG_HISTORY; // safe fallback type
     strcpy(error.payload, "Unknown packet.");
     send_packet(client_socket, error);
-    break;
-}
-
-    }
 }
 
 // ---------------------------
@@ -192,10 +363,19 @@ void worker_thread() {
         // Update performance metrics
         metrics.log_job(job.burst_time);
 
+        tracer.set_current(job.trace_id);
+        tracer.span(job.trace_id, "queue_wait",
+                    tracer.to_us(job.enqueued_at), tracer.now_us());
+
         // Execute the job
-        job.task();
+        {
+            TraceScope span(tracer, job.trace_id, "dispatch");
+            job.task();
+        }
+        tracer.set_current(0);
 
         // Update performance metrics file LIVE
+        metrics.set_slow_member_drops(fanout.dropped_packets());
         metrics.write_report("logs/performance_metrics.txt");
     }
 }
@@ -206,9 +386,19 @@ void worker_thread() {
 // Client Handler
 // ---------------------------
 
-void handle_client(int client_socket) {
+void handle_client(int client_socket, uint32_t conn_id) {
+    ReceiveBuffer rx;
+    int slot = -1;   // slot being filled, kept until a job takes it
+
+    groupManager.add_client(client_socket, conn_id);
+    fanout.open(client_socket, conn_id);
+
     while (true) {
-        Packet pkt{};
+        if (slot < 0)
+            slot = rx.acquire();
+
+        Packet &pkt = rx.slot(slot);
+        pkt = Packet();
         ssize_t bytes = read(client_socket, &pkt, sizeof(pkt));
 
         // -------------------------
@@ -216,10 +406,27 @@ void handle_client(int client_socket) {
         // -------------------------
         if (bytes <= 0) {
             logger.log("Client FD " + std::to_string(client_socket) + " disconnected.");
+            capture.record_close(conn_id);
+            limiter.remove_connection(client_socket);
+
+            // Let queued jobs finish with rx (a late JOIN would put the fd
+            // back in its group), stop broadcasts to it, then let the lane
+            // write what was sent before closing
+            rx.release(slot);
+            rx.drain();
+            groupManager.remove_client(client_socket);
+            fanout.forget(client_socket);
+
             close(client_socket);
             return;
         }
 
+        capture.record_packet(conn_id, pkt);
+
+        uint64_t trace_id = tracer.sample();
+        tracer.instant(trace_id, "recv");
+        long validate_start = tracer.now_us();
+
         // -------------------------
         // SECOND: validate protocol version
         // -------------------------
@@ -247,16 +454,59 @@ void handle_client(int client_socket) {
             continue;
         }
 
+        tracer.span(trace_id, "validate", validate_start, tracer.now_us());
+
+        // -------------------------
+        // FOURTH: admission control
+        // -------------------------
+        long admit_start = tracer.now_us();
+
+        if (!limiter.allow_connection(client_socket)) {
+            metrics.log_throttled(false);
+            send_system(client_socket, "Rate limit exceeded, slow down.");
+            continue;
+        }
+
+        if (pkt.type == MSG_SEND && !limiter.allow_group(pkt.group_id)) {
+            metrics.log_throttled(true);
+            send_system(client_socket, "Group is busy, message dropped.");
+            continue;
+        }
+
+        // History replays, searches and resumes are the most expensive
+        // jobs, drop them first
+        if ((pkt.type == MSG_HISTORY || pkt.type == MSG_SEARCH ||
+             pkt.type == MSG_RESUME) && server_overloaded()) {
+            metrics.log_shed(false);
+            send_system(client_socket, "Server busy, try again later.");
+            continue;
+        }
+
+        tracer.span(trace_id, "admit", admit_start, tracer.now_us());
+
         // -------------------------
-        // FOURTH: schedule the job
+        // FIFTH: schedule the job
         // -------------------------
         int burst = random_burst();
 
-        Job job(client_socket, burst, [pkt, client_socket]() {
-            process_packet(pkt, client_socket);
+        // The job reads the packet in place and hands the slot back
+        Job job(client_socket, burst, [&rx, slot, client_socket]() {
+            process_packet(PacketView(rx.slot(slot)), client_socket);
+            rx.release(slot);
         });
 
-        scheduler.add_job(job);
+        job.trace_id = trace_id;
+
+        long enqueue_start = tracer.now_us();
+        bool queued = scheduler.add_job(std::move(job));
+        tracer.span(trace_id, "add_job", enqueue_start, tracer.now_us());
+
+        if (queued) {
+            slot = -1;
+        } else {
+            metrics.log_shed(true);
+            send_system(client_socket, "Server busy, try again later.");
+        }
     }
 }
 
@@ -265,7 +515,57 @@ void handle_client(int client_socket) {
 // Main Server
 // ---------------------------
 
-int main() {
+// SIGUSR1 dumps the trace file, SIGINT / SIGTERM stop the server
+void signal_thread(sigset_t signals) {
+    while (true) {
+        int sig = 0;
+        if (sigwait(&signals, &sig) != 0)
+            continue;
+
+        capture.flush();
+
+        if (sig == SIGUSR1) {
+            tracer.dump(TRACE_FILE);
+            logger.log(std::string("Trace written to ") + TRACE_FILE);
+        } else {
+            // SIGINT / SIGTERM: shut down with the capture file complete.
+            // _exit skips static destructors, which other threads still use.
+            metrics.write_report("logs/performance_metrics.txt");
+            _exit(0);
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--capture" && i + 1 < argc) {
+            if (!capture.open(argv[++i])) {
+                std::cerr << "Cannot open capture file " << argv[i] << std::endl;
+                return 1;
+            }
+            std::cout << "Capturing inbound traffic to " << argv[i] << std::endl;
+        }
+    }
+
+    // Block these before any thread starts so only the signal thread gets them
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGUSR1);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+    std::thread sig_thread(signal_thread, signals);
+    sig_thread.detach();
+
+    fanout.start();
+
+    // Every client holds a socket; raise the open file limit to fit them
+    rlimit files{};
+    if (getrlimit(RLIMIT_NOFILE, &files) == 0 && files.rlim_cur < MAX_CLIENTS + 64) {
+        files.rlim_cur = std::min<rlim_t>(files.rlim_max, MAX_CLIENTS + 64);
+        setrlimit(RLIMIT_NOFILE, &files);
+    }
+
     int server_fd = socket(AF_INET, SOCK_STREAM, 0);
 
     sockaddr_in addr{};
@@ -274,9 +574,9 @@ int main() {
     addr.sin_port = htons(8080);
 
     bind(server_fd, (sockaddr*)&addr, sizeof(addr));
-    listen(server_fd, 10);
+    listen(server_fd, SOMAXCONN);
 
-    ThreadPool pool(4);
+    ThreadPool pool(MAX_CLIENTS);
 
     // Two RR worker threads
     std::thread worker1(worker_thread);
@@ -284,11 +584,15 @@ int main() {
 
     std::cout << "Server running with ROUND ROBIN scheduler..." << std::endl;
 
+    uint32_t next_conn_id = 1;
+
     while (true) {
         
         int client = accept(server_fd, nullptr, nullptr);
-        pool.enqueue([client] {
-            handle_client(client);
+
+        uint32_t conn_id = next_conn_id++;
+        pool.enqueue([client, conn_id] {
+            handle_client(client, conn_id);
         });
     }
 
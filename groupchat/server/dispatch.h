@@ -0,0 +1,40 @@
+#ifndef DISPATCH_H
+#define DISPATCH_H
+
+#include <array>
+#include <algorithm>
+#include <cstdint>
+#include "../shared/protocol.h"
+
+// --------------------------------------------------
+// Packet Handlers
+// --------------------------------------------------
+// Specialize PacketHandler<TYPE> with a static handle() for each packet
+// type the server accepts. Listing a type in the dispatch table without a
+// specialization is a compile error.
+template <uint16_t Type>
+struct PacketHandler;
+
+using HandlerFn = void (*)(const PacketView &, int);
+
+// --------------------------------------------------
+// Dispatch Table
+// --------------------------------------------------
+// Built at compile time: table[type] -> handler, nullptr if unhandled.
+template <uint16_t... Types>
+class DispatchTable {
+private:
+    static constexpr size_t SIZE = std::max({Types...}) + 1;
+    std::array<HandlerFn, SIZE> table{};
+
+public:
+    constexpr DispatchTable() {
+        ((table[Types] = &PacketHandler<Types>::handle), ...);
+    }
+
+    constexpr HandlerFn lookup(uint16_t type) const {
+        return type < SIZE ? table[type] : nullptr;
+    }
+};
+
+#endif // DISPATCH_H
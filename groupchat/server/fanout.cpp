@@ -0,0 +1,331 @@
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "../shared/protocol.h"
+#include "member.h"
+
+// --------------------------------------------------
+// Send Lanes
+// --------------------------------------------------
+// Every packet the server writes goes through Fanout. Each connection is
+// owned by one lane (fd % lanes), a single thread with a bounded FIFO, so
+// one socket is only ever written by one thread and its packets go out in
+// the order they were queued. Broadcasts to different members run on
+// different lanes in parallel.
+//
+// Sends never block. When a member's socket buffer is full, the rest of
+// the packet and anything after it wait in that member's backlog, which
+// the lane retries between items. A member whose backlog is full loses
+// new packets (counted as drops) instead of stalling the lane.
+//
+// Broadcast targets carry the connection id they joined with. The lane
+// learns which connection owns an fd from open()/forget(), which travel
+// through the same FIFO, and skips targets whose connection has closed,
+// even if the fd has since been reused.
+
+// Shared by the lane items of one broadcast (or flush)
+struct SendState {
+    using DoneFn = std::function<void(long latency_us, bool waited)>;
+
+    std::chrono::steady_clock::time_point start;
+    DoneFn done;
+    bool waited = false;
+    size_t remaining = 0;
+
+    std::mutex lock;
+    std::condition_variable cv;
+
+    void finish_one() {
+        std::unique_lock<std::mutex> guard(lock);
+        if (--remaining > 0)
+            return;
+
+        if (done) {
+            long us = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count();
+            done(us, waited);
+        }
+        cv.notify_all();
+    }
+
+    void wait() {
+        std::unique_lock<std::mutex> guard(lock);
+        cv.wait(guard, [this] { return remaining == 0; });
+    }
+};
+
+struct SendItem {
+    Packet pkt;
+    int fd = -1;                        // single send (or connection to open/forget)
+    bool open = false;                  // fd now belongs to conn_id
+    bool forget = false;                // fd is closing, drop its backlog
+    uint32_t conn_id = 0;
+    std::vector<Member> members;        // broadcast chunk
+    std::shared_ptr<SendState> state;   // null for single sends
+};
+
+class SendLane {
+private:
+    static const size_t BACKLOG_LIMIT = 1024;   // packets per slow member
+
+    // Packets a member's socket had no room for; `sent` bytes of the first
+    // one already went out
+    struct Backlog {
+        std::deque<Packet> packets;
+        size_t sent = 0;
+    };
+
+    std::deque<SendItem> items;
+    size_t capacity;
+    bool stop = false;
+
+    std::mutex lock;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+    std::thread worker;
+
+    // Only touched by the lane thread
+    std::unordered_map<int, Backlog> backlogs;
+    std::unordered_map<int, uint32_t> owners;   // fd -> open connection
+
+    std::atomic<long> &dropped;
+
+    void deliver(int fd, const Packet &pkt) {
+        auto it = backlogs.find(fd);
+        if (it != backlogs.end()) {
+            // Keep order: queue behind what is already waiting
+            if (it->second.packets.size() >= BACKLOG_LIMIT)
+                dropped++;
+            else
+                it->second.packets.push_back(pkt);
+            return;
+        }
+
+        ssize_t n = send(fd, &pkt, sizeof(pkt), MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (n == (ssize_t)sizeof(pkt))
+            return;
+        if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+            return;   // connection is gone
+
+        Backlog &b = backlogs[fd];
+        b.packets.push_back(pkt);
+        b.sent = n < 0 ? 0 : n;
+    }
+
+    // Push out as much backlog as the sockets will take right now
+    void pump() {
+        for (auto it = backlogs.begin(); it != backlogs.end();) {
+            Backlog &b = it->second;
+            bool gone = false;
+
+            while (!b.packets.empty()) {
+                const char *p = (const char*)&b.packets.front() + b.sent;
+                ssize_t n = send(it->first, p, sizeof(Packet) - b.sent,
+                                 MSG_DONTWAIT | MSG_NOSIGNAL);
+                if (n < 0) {
+                    gone = errno != EAGAIN && errno != EWOULDBLOCK;
+                    break;
+                }
+                b.sent += n;
+                if (b.sent == sizeof(Packet)) {
+                    b.packets.pop_front();
+                    b.sent = 0;
+                }
+            }
+
+            if (gone || b.packets.empty())
+                it = backlogs.erase(it);
+            else
+                ++it;
+        }
+    }
+
+    void run() {
+        while (true) {
+            SendItem item;
+            bool have_item = false;
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                auto ready = [this] { return stop || !items.empty(); };
+
+                // With a backlog, wake up now and then to retry it
+                if (backlogs.empty())
+                    not_empty.wait(guard, ready);
+                else
+                    not_empty.wait_for(guard, std::chrono::milliseconds(2), ready);
+
+                if (stop && items.empty())
+                    return;
+
+                if (!items.empty()) {
+                    item = std::move(items.front());
+                    items.pop_front();
+                    have_item = true;
+                }
+            }
+
+            if (have_item) {
+                not_full.notify_one();
+
+                if (item.open) {
+                    owners[item.fd] = item.conn_id;
+                } else if (item.forget) {
+                    owners.erase(item.fd);
+                    backlogs.erase(item.fd);
+                } else if (item.fd >= 0) {
+                    deliver(item.fd, item.pkt);
+                }
+
+                for (const Member &m : item.members) {
+                    auto owner = owners.find(m.fd);
+                    if (owner != owners.end() && owner->second == m.conn_id)
+                        deliver(m.fd, item.pkt);
+                }
+
+                if (item.state)
+                    item.state->finish_one();
+            }
+
+            if (!backlogs.empty())
+                pump();
+        }
+    }
+
+public:
+    SendLane(size_t cap, std::atomic<long> &drop_count)
+        : capacity(cap), dropped(drop_count) {
+        worker = std::thread([this] { run(); });
+    }
+
+    // Blocks while the lane is full, pushing back on whoever is sending
+    void push(SendItem item) {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            not_full.wait(guard, [this] { return items.size() < capacity; });
+            items.push_back(std::move(item));
+        }
+        not_empty.notify_one();
+    }
+
+    ~SendLane() {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stop = true;
+        }
+        not_empty.notify_all();
+        worker.join();
+    }
+};
+
+// --------------------------------------------------
+// Fan-out
+// --------------------------------------------------
+// Groups below `threshold` are queued and the worker moves on. For larger
+// groups the worker waits until every lane has written its chunk, so the
+// cost of big broadcasts stays visible to the scheduler (queue depth and
+// dispatch latency) and to the "broadcast" trace span.
+class Fanout {
+private:
+    size_t lane_count;
+    size_t lane_capacity;
+    size_t threshold;
+    std::vector<std::unique_ptr<SendLane>> lanes;
+    std::atomic<long> dropped{0};
+
+    SendLane &lane_for(int fd) { return *lanes[fd % lanes.size()]; }
+
+public:
+    using DoneFn = SendState::DoneFn;
+
+    Fanout(size_t count, size_t capacity, size_t parallel_threshold)
+        : lane_count(count), lane_capacity(capacity),
+          threshold(parallel_threshold) {}
+
+    // Starts the lane threads. Call from main once signal masks are set,
+    // since threads inherit the mask of the thread that creates them.
+    void start() {
+        for (size_t i = 0; i < lane_count; i++)
+            lanes.emplace_back(new SendLane(lane_capacity, dropped));
+    }
+
+    // A new connection on fd; broadcasts only reach it once this is queued
+    void open(int fd, uint32_t conn_id) {
+        SendItem item;
+        item.fd = fd;
+        item.open = true;
+        item.conn_id = conn_id;
+        lane_for(fd).push(std::move(item));
+    }
+
+    // Not checked against the owner: only the connection's own reader and
+    // jobs send to it directly, and they have finished before forget()
+    void send(int fd, const Packet &pkt) {
+        SendItem item;
+        item.pkt = pkt;
+        item.fd = fd;
+        lane_for(fd).push(std::move(item));
+    }
+
+    // `done` runs once the last member has been written to
+    void broadcast(const std::vector<Member> &members, const Packet &pkt, DoneFn done) {
+        auto state = std::make_shared<SendState>();
+        state->start = std::chrono::steady_clock::now();
+        state->done = done;
+        state->waited = members.size() >= threshold;
+
+        std::vector<std::vector<Member>> chunks(lanes.size());
+        for (const Member &m : members)
+            chunks[m.fd % lanes.size()].push_back(m);
+
+        for (auto &chunk : chunks)
+            if (!chunk.empty())
+                state->remaining++;
+
+        if (state->remaining == 0) {
+            done(0, false);
+            return;
+        }
+
+        for (size_t i = 0; i < lanes.size(); i++) {
+            if (chunks[i].empty())
+                continue;
+
+            SendItem item;
+            item.pkt = pkt;
+            item.members = std::move(chunks[i]);
+            item.state = state;
+            lanes[i]->push(std::move(item));
+        }
+
+        if (state->waited)
+            state->wait();
+    }
+
+    // The connection is closing: wait until everything already queued for
+    // fd has been tried, then drop whatever is still in its backlog so a
+    // reused fd starts clean. Broadcasts queued later for this connection
+    // are skipped.
+    void forget(int fd) {
+        auto state = std::make_shared<SendState>();
+        state->remaining = 1;
+
+        SendItem item;
+        item.fd = fd;
+        item.forget = true;
+        item.state = state;
+        lane_for(fd).push(std::move(item));
+        state->wait();
+    }
+
+    long dropped_packets() const { return dropped.load(); }
+};
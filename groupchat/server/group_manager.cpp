@@ -2,43 +2,166 @@
 #include <vector>
 #include <mutex>
 #include <algorithm>
+#include <memory>
+#include <functional>
 #include "../shared/message.h"
+#include "member.h"
+#include "search_index.cpp"
+
+// Outcome of get_since()
+enum ResumeStatus {
+    RESUME_OK,      // missed messages returned
+    RESUME_GAP,     // too many missed, refetch history
+    RESUME_RESET,   // client is ahead of the server (history was lost)
+};
 
 class GroupManager {
 private:
-    std::unordered_map<uint32_t, std::vector<Message>> groups;
-    std::unordered_map<uint32_t, std::vector<int>> members; 
-    std::mutex lock;
+    // History and index of one group, behind their own lock so a slow
+    // search only holds up its own group
+    struct GroupData {
+        std::mutex lock;
+        std::vector<Message> history;
+        SearchIndex index;
+    };
+
+    std::unordered_map<uint32_t, std::unique_ptr<GroupData>> groups;
+    std::unordered_map<uint32_t, std::vector<Member>> members;
+    std::unordered_map<int, uint32_t> clients;   // fd -> connection id
+    std::mutex lock;   // guards the maps, not the group contents
+
+    static void remove_fd(std::vector<Member> &vec, int client_fd) {
+        vec.erase(std::remove_if(vec.begin(), vec.end(),
+                                 [client_fd](const Member &m) { return m.fd == client_fd; }),
+                  vec.end());
+    }
+
+    // Creates the group; only for paths that add to it
+    GroupData &group_data(uint32_t group) {
+        std::lock_guard<std::mutex> guard(lock);
+        auto &g = groups[group];
+        if (!g)
+            g.reset(new GroupData);
+        return *g;
+    }
+
+    // nullptr if nothing was ever stored in the group. Read paths use this
+    // so client-chosen group ids do not allocate anything.
+    GroupData *find_group(uint32_t group) {
+        std::lock_guard<std::mutex> guard(lock);
+        auto it = groups.find(group);
+        return it == groups.end() ? nullptr : it->second.get();
+    }
 
 public:
 
-    // Add a client to a group
+    // A new connection on client_fd, before any of its packets are handled
+    void add_client(int client_fd, uint32_t conn_id) {
+        std::lock_guard<std::mutex> guard(lock);
+        clients[client_fd] = conn_id;
+    }
+
+    // Add a client to a group (joining twice is a no-op)
     void join_group(uint32_t group, int client_fd) {
         std::lock_guard<std::mutex> guard(lock);
-        members[group].push_back(client_fd);
+        auto it = clients.find(client_fd);
+        if (it == clients.end())
+            return;
+
+        auto &vec = members[group];
+        for (const Member &m : vec)
+            if (m.fd == client_fd)
+                return;
+        vec.push_back({client_fd, it->second});
     }
 
     // Remove client from group
     void leave_group(uint32_t group, int client_fd) {
         std::lock_guard<std::mutex> guard(lock);
-        auto &vec = members[group];
-        vec.erase(std::remove(vec.begin(), vec.end(), client_fd), vec.end());
+        auto it = members.find(group);
+        if (it == members.end())
+            return;
+        remove_fd(it->second, client_fd);
     }
 
-    // Store message in history
-    void store_message(uint32_t group, const Message &msg) {
+    // Remove a disconnected client from every group
+    void remove_client(int client_fd) {
         std::lock_guard<std::mutex> guard(lock);
-        groups[group].push_back(msg);
+        clients.erase(client_fd);
+        for (auto &entry : members)
+            remove_fd(entry.second, client_fd);
+    }
+
+    // Store message in history and stamp it with the group's next sequence
+    // number (history[i] always holds seq i + 1). `publish` runs before the
+    // group lock is released, so whatever it queues for members is queued
+    // in seq order. It must not call back into this group's data.
+    // Returns the sequence.
+    uint32_t store_message(uint32_t group, Message &msg,
+                           const std::function<void(const Message &)> &publish) {
+        GroupData &g = group_data(group);
+        std::lock_guard<std::mutex> guard(g.lock);
+        msg.seq = g.history.size() + 1;
+        g.history.push_back(msg);
+        g.index.add(msg);
+
+        if (publish)
+            publish(msg);
+        return msg.seq;
+    }
+
+    // Messages after `last_seq`, for clients resuming after a reconnect.
+    // Nothing is copied unless the result is RESUME_OK.
+    ResumeStatus get_since(uint32_t group, uint32_t last_seq, size_t max_gap,
+                           std::vector<Message> &missed, uint32_t &latest) {
+        GroupData *g = find_group(group);
+        if (!g) {
+            latest = 0;
+            return last_seq > 0 ? RESUME_RESET : RESUME_OK;
+        }
+
+        std::lock_guard<std::mutex> guard(g->lock);
+        latest = g->history.size();
+
+        if (last_seq > latest)
+            return RESUME_RESET;
+        if (latest - last_seq > max_gap)
+            return RESUME_GAP;
+
+        missed.assign(g->history.begin() + last_seq, g->history.end());
+        return RESUME_OK;
+    }
+
+    // One page of search results, newest first. `more` is set if another
+    // page exists.
+    std::vector<Message> search(uint32_t group, const SearchQuery &query,
+                                size_t page_size, bool &more) {
+        std::vector<Message> results;
+        more = false;
+
+        GroupData *g = find_group(group);
+        if (!g)
+            return results;
+
+        std::lock_guard<std::mutex> guard(g->lock);
+        for (uint32_t id : g->index.search(query, page_size, more))
+            results.push_back(g->history[id]);
+        return results;
     }
 
     std::vector<Message> get_history(uint32_t group) {
-        std::lock_guard<std::mutex> guard(lock);
-        return groups[group];
+        GroupData *g = find_group(group);
+        if (!g)
+            return {};
+
+        std::lock_guard<std::mutex> guard(g->lock);
+        return g->history;
     }
 
     // Get member client sockets for broadcast
-    std::vector<int> get_members(uint32_t group) {
+    std::vector<Member> get_members(uint32_t group) {
         std::lock_guard<std::mutex> guard(lock);
-        return members[group];
+        auto it = members.find(group);
+        return it == members.end() ? std::vector<Member>() : it->second;
     }
 };
@@ -3,15 +3,19 @@
 
 #include <string>
 #include <functional>
+#include <chrono>
+#include <cstdint>
 
 struct Job {
     int client_fd;
     int burst_time;      // simulated job time
     int remaining_time;  // for RR scheduling
     std::function<void()> task;
+    std::chrono::steady_clock::time_point enqueued_at;  // for dispatch latency
+    uint64_t trace_id = 0;  // 0 if this packet is not sampled
 
     Job(int fd, int bt, std::function<void()> fn)
-        : client_fd(fd), burst_time(bt), remaining_time(bt), task(fn) {}
+        : client_fd(fd), burst_time(bt), remaining_time(bt), task(std::move(fn)) {}
 };
 
 #endif // JOB_H
@@ -0,0 +1,14 @@
+#ifndef MEMBER_H
+#define MEMBER_H
+
+#include <cstdint>
+
+// A connected client as group membership and fan-out see it. conn_id is
+// unique per connection, so a send meant for a closed connection can be
+// told apart from one for a later connection that reused its fd.
+struct Member {
+    int fd;
+    uint32_t conn_id;
+};
+
+#endif // MEMBER_H
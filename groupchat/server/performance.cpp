@@ -13,6 +13,15 @@ public:
     long cache_misses = 0;
     long messages_sent = 0;
     long scheduler_dispatches = 0;
+    long throttled_connection = 0;
+    long throttled_group = 0;
+    long shed_queue_full = 0;
+    long shed_overload = 0;
+    long fanouts = 0;
+    long large_fanouts = 0;
+    long total_last_member_us = 0;
+    long max_last_member_us = 0;
+    long slow_member_drops = 0;
 
     void log_job(int burst) {
         std::lock_guard<std::mutex> guard(lock);
@@ -36,6 +45,41 @@ public:
         messages_sent++;
     }
 
+    // Packets rejected by a token bucket
+    void log_throttled(bool group_bucket) {
+        std::lock_guard<std::mutex> guard(lock);
+        if (group_bucket)
+            throttled_group++;
+        else
+            throttled_connection++;
+    }
+
+    // Packets dropped by load shedding
+    void log_shed(bool queue_full) {
+        std::lock_guard<std::mutex> guard(lock);
+        if (queue_full)
+            shed_queue_full++;
+        else
+            shed_overload++;
+    }
+
+    // Time from start of a broadcast until the last member was written
+    void log_fanout(long latency_us, bool large_group) {
+        std::lock_guard<std::mutex> guard(lock);
+        fanouts++;
+        if (large_group)
+            large_fanouts++;
+        total_last_member_us += latency_us;
+        if (latency_us > max_last_member_us)
+            max_last_member_us = latency_us;
+    }
+
+    // Packets skipped because a member's socket buffer was full
+    void set_slow_member_drops(long count) {
+        std::lock_guard<std::mutex> guard(lock);
+        slow_member_drops = count;
+    }
+
     void write_report(const std::string &filename) {
         std::lock_guard<std::mutex> guard(lock);
         std::ofstream out(filename);
@@ -55,6 +99,18 @@ public:
             << (total_cache == 0 ? 0 : (float)cache_hits / total_cache)
             << "\n";
 
+        out << "Throttled (connection): " << throttled_connection << "\n";
+        out << "Throttled (group): " << throttled_group << "\n";
+        out << "Shed (queue full): " << shed_queue_full << "\n";
+        out << "Shed (overload): " << shed_overload << "\n";
+
+        out << "Broadcasts: " << fanouts
+            << " (large groups: " << large_fanouts << ")\n";
+        out << "Last Member Latency Avg (us): "
+            << (fanouts == 0 ? 0 : total_last_member_us / fanouts) << "\n";
+        out << "Last Member Latency Max (us): " << max_last_member_us << "\n";
+        out << "Slow Member Drops: " << slow_member_drops << "\n";
+
         out << "============================\n";
         out.close();
     }
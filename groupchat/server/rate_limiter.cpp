@@ -0,0 +1,106 @@
+#include <unordered_map>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+
+// --------------------------------------------------
+// Token Bucket
+// --------------------------------------------------
+// Holds up to `capacity` tokens and refills at `rate` tokens per second.
+// Every admitted packet costs one token.
+class TokenBucket {
+private:
+    double capacity;
+    double rate;
+    double tokens;
+    std::chrono::steady_clock::time_point last_refill;
+
+    void refill() {
+        auto now = std::chrono::steady_clock::now();
+        double elapsed =
+            std::chrono::duration<double>(now - last_refill).count();
+        tokens = std::min(capacity, tokens + elapsed * rate);
+        last_refill = now;
+    }
+
+public:
+    TokenBucket(double cap = 1, double per_sec = 1)
+        : capacity(cap), rate(per_sec), tokens(cap),
+          last_refill(std::chrono::steady_clock::now()) {}
+
+    bool try_consume(double cost = 1) {
+        refill();
+        if (tokens < cost)
+            return false;
+        tokens -= cost;
+        return true;
+    }
+
+    // Refilled to capacity, so indistinguishable from a fresh bucket
+    bool idle() {
+        refill();
+        return tokens >= capacity;
+    }
+};
+
+// --------------------------------------------------
+// Rate Limiter
+// --------------------------------------------------
+// One bucket per client connection (all packet types) and one per group
+// (messages that fan out to the whole group). Group ids come from clients,
+// so idle group buckets are swept once the map grows past `sweep_at`.
+class RateLimiter {
+private:
+    static constexpr size_t MIN_SWEEP = 1024;
+
+    double conn_burst, conn_rate;
+    double group_burst, group_rate;
+    size_t sweep_at = MIN_SWEEP;
+
+    std::unordered_map<int, TokenBucket> connections;
+    std::unordered_map<uint32_t, TokenBucket> groups;
+    std::mutex lock;
+
+    // Caller holds lock. Doubling sweep_at keeps sweeps amortized O(1).
+    void sweep_groups() {
+        for (auto it = groups.begin(); it != groups.end();) {
+            if (it->second.idle())
+                it = groups.erase(it);
+            else
+                ++it;
+        }
+        sweep_at = std::max(MIN_SWEEP, groups.size() * 2);
+    }
+
+public:
+    RateLimiter(double c_burst, double c_rate, double g_burst, double g_rate)
+        : conn_burst(c_burst), conn_rate(c_rate),
+          group_burst(g_burst), group_rate(g_rate) {}
+
+    bool allow_connection(int client_fd) {
+        std::lock_guard<std::mutex> guard(lock);
+        auto it = connections.find(client_fd);
+        if (it == connections.end())
+            it = connections.emplace(client_fd,
+                     TokenBucket(conn_burst, conn_rate)).first;
+        return it->second.try_consume();
+    }
+
+    bool allow_group(uint32_t group) {
+        std::lock_guard<std::mutex> guard(lock);
+        auto it = groups.find(group);
+        if (it == groups.end()) {
+            if (groups.size() >= sweep_at)
+                sweep_groups();
+            it = groups.emplace(group,
+                     TokenBucket(group_burst, group_rate)).first;
+        }
+        return it->second.try_consume();
+    }
+
+    // Drop the bucket when the socket closes (fds get reused)
+    void remove_connection(int client_fd) {
+        std::lock_guard<std::mutex> guard(lock);
+        connections.erase(client_fd);
+    }
+};
@@ -0,0 +1,55 @@
+#include <mutex>
+#include <condition_variable>
+#include "../shared/protocol.h"
+
+// --------------------------------------------------
+// Receive Buffer (one per connection)
+// --------------------------------------------------
+// A fixed set of packet slots owned by handle_client. Each packet is read
+// straight into a free slot and its job reads it in place through a
+// PacketView; the job hands the slot back when it finishes. If every slot
+// is in flight the reader waits, which also throttles a client that is
+// far ahead of the workers.
+class ReceiveBuffer {
+public:
+    static const int SLOTS = 8;   // most jobs one connection can have queued
+
+private:
+    Packet slots[SLOTS];
+    bool in_use[SLOTS] = {};
+    int used = 0;
+
+    std::mutex lock;
+    std::condition_variable cv;
+
+public:
+    // Blocks until a slot is free
+    int acquire() {
+        std::unique_lock<std::mutex> guard(lock);
+        cv.wait(guard, [this] { return used < SLOTS; });
+
+        int i = 0;
+        while (in_use[i])
+            i++;
+        in_use[i] = true;
+        used++;
+        return i;
+    }
+
+    Packet &slot(int i) { return slots[i]; }
+
+    void release(int i) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            in_use[i] = false;
+            used--;
+        }
+        cv.notify_all();
+    }
+
+    // Wait for every queued job to finish with its slot
+    void drain() {
+        std::unique_lock<std::mutex> guard(lock);
+        cv.wait(guard, [this] { return used == 0; });
+    }
+};
@@ -2,21 +2,29 @@
 #include <queue>
 #include <mutex>
 #include <condition_variable>
+#include <chrono>
 
 class Scheduler {
 private:
     std::queue<Job> rr_queue;
     std::mutex lock;
     std::condition_variable cv;
+    size_t capacity;
 
 public:
+    Scheduler(size_t cap) : capacity(cap) {}
 
-    void add_job(const Job &job) {
+    // Returns false (job dropped) when the queue is full
+    bool add_job(Job job) {
         {
             std::lock_guard<std::mutex> guard(lock);
-            rr_queue.push(job);
+            if (rr_queue.size() >= capacity)
+                return false;
+            job.enqueued_at = std::chrono::steady_clock::now();
+            rr_queue.push(std::move(job));
         }
         cv.notify_one();
+        return true;
     }
 
     Job get_next_job() {
@@ -24,9 +32,24 @@ public:
 
         cv.wait(guard, [&] { return !rr_queue.empty(); });
 
-        Job job = rr_queue.front();
+        Job job = std::move(rr_queue.front());
         rr_queue.pop();
 
         return job;  // NO REQUEUE
     }
+
+    size_t depth() {
+        std::lock_guard<std::mutex> guard(lock);
+        return rr_queue.size();
+    }
+
+    // How long the oldest queued job has been waiting (0 if idle), i.e. the
+    // dispatch latency the next job will see at least
+    long dispatch_latency_us() {
+        std::lock_guard<std::mutex> guard(lock);
+        if (rr_queue.empty())
+            return 0;
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - rr_queue.front().enqueued_at).count();
+    }
 };
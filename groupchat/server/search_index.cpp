@@ -0,0 +1,289 @@
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstdint>
+#include "../shared/message.h"
+
+// --------------------------------------------------
+// Posting List (delta + varint compressed)
+// --------------------------------------------------
+// Message ids are appended in increasing order and stored in blocks of
+// BLOCK_SIZE. The first id of every block is kept in a skip table; the
+// rest are gaps from the previous id in 7-bit varint form. Searches read
+// newest first, so they decode one block at a time from the end.
+class PostingList {
+private:
+    static const uint32_t BLOCK_SIZE = 128;
+
+    std::vector<uint8_t> bytes;
+    std::vector<uint32_t> block_first;   // first id of each block
+    std::vector<uint32_t> block_offset;  // where its gaps start in bytes
+    uint32_t last = 0;
+    uint32_t count = 0;
+
+public:
+    void add(uint32_t id) {
+        if (count > 0 && id == last)
+            return;  // term repeated in the same message
+
+        if (count % BLOCK_SIZE == 0) {
+            block_first.push_back(id);
+            block_offset.push_back(bytes.size());
+        } else {
+            uint32_t delta = id - last;
+            while (delta >= 0x80) {
+                bytes.push_back((delta & 0x7F) | 0x80);
+                delta >>= 7;
+            }
+            bytes.push_back(delta);
+        }
+
+        last = id;
+        count++;
+    }
+
+    // Last block whose first id is <= target, -1 if none
+    int find_block(uint32_t target) const {
+        auto it = std::upper_bound(block_first.begin(), block_first.end(), target);
+        return (int)(it - block_first.begin()) - 1;
+    }
+
+    void decode_block(int block, std::vector<uint32_t> &ids) const {
+        size_t i = block_offset[block];
+        size_t end = block + 1 < (int)block_offset.size()
+                         ? block_offset[block + 1] : bytes.size();
+        uint32_t id = block_first[block];
+
+        ids.clear();
+        ids.push_back(id);
+        while (i < end) {
+            uint32_t delta = 0;
+            int shift = 0;
+            while (bytes[i] & 0x80) {
+                delta |= (uint32_t)(bytes[i++] & 0x7F) << shift;
+                shift += 7;
+            }
+            delta |= (uint32_t)bytes[i++] << shift;
+
+            id += delta;
+            ids.push_back(id);
+        }
+    }
+};
+
+// --------------------------------------------------
+// Posting Cursor
+// --------------------------------------------------
+// Walks one posting list from newest to oldest. seek(t) moves to the
+// largest id <= t; targets must only decrease.
+class PostingCursor {
+private:
+    const PostingList *list;
+    std::vector<uint32_t> ids;   // decoded current block
+    int block = -1;
+    int pos = -1;
+
+public:
+    explicit PostingCursor(const PostingList &l) : list(&l) { seek(UINT32_MAX); }
+
+    bool valid() const { return pos >= 0; }
+    uint32_t id() const { return ids[pos]; }
+
+    void seek(uint32_t target) {
+        if (block < 0 || target < ids.front()) {
+            int b = list->find_block(target);
+            if (b < 0) {
+                pos = -1;
+                return;
+            }
+            list->decode_block(b, ids);
+            block = b;
+        }
+        pos = (int)(std::upper_bound(ids.begin(), ids.end(), target) - ids.begin()) - 1;
+    }
+};
+
+// --------------------------------------------------
+// Union Cursor
+// --------------------------------------------------
+// One query filter: an exact term (one list) or a prefix (every list whose
+// term starts with it). id() is the newest id still ahead in any list.
+class UnionCursor {
+private:
+    std::vector<PostingCursor> cursors;
+
+public:
+    void add(const PostingList &list) { cursors.emplace_back(list); }
+
+    bool valid() const {
+        for (auto &c : cursors)
+            if (c.valid())
+                return true;
+        return false;
+    }
+
+    uint32_t id() const {
+        uint32_t best = 0;
+        for (auto &c : cursors)
+            if (c.valid() && c.id() > best)
+                best = c.id();
+        return best;
+    }
+
+    void seek(uint32_t target) {
+        for (auto &c : cursors)
+            if (c.valid() && c.id() > target)
+                c.seek(target);
+    }
+};
+
+// --------------------------------------------------
+// Search Query
+// --------------------------------------------------
+// Space separated, all parts must match:
+//   word        exact term
+//   wor*        term prefix
+//   from:<id>   sender filter
+//   page:<n>    result page (1-based, at most MAX_PAGE)
+struct SearchQuery {
+    static constexpr uint32_t MAX_PAGE = 1000;
+
+    std::vector<std::string> terms;
+    std::vector<std::string> prefixes;
+    bool has_sender = false;
+    uint32_t sender = 0;
+    uint32_t page = 1;
+
+    static SearchQuery parse(const std::string &text);
+};
+
+// Lower-cased alphanumeric words
+inline std::vector<std::string> tokenize(const std::string &text) {
+    std::vector<std::string> words;
+    std::string cur;
+    for (char c : text) {
+        if (std::isalnum((unsigned char)c)) {
+            cur += std::tolower((unsigned char)c);
+        } else if (!cur.empty()) {
+            words.push_back(cur);
+            cur.clear();
+        }
+    }
+    if (!cur.empty())
+        words.push_back(cur);
+    return words;
+}
+
+SearchQuery SearchQuery::parse(const std::string &text) {
+    SearchQuery q;
+    std::istringstream in(text);
+    std::string part;
+
+    while (in >> part) {
+        if (part.rfind("from:", 0) == 0) {
+            q.has_sender = true;
+            q.sender = std::strtoul(part.c_str() + 5, nullptr, 10);
+        } else if (part.rfind("page:", 0) == 0) {
+            unsigned long page = std::strtoul(part.c_str() + 5, nullptr, 10);
+            q.page = std::min<unsigned long>(std::max(1ul, page), MAX_PAGE);
+        } else if (part.back() == '*') {
+            auto words = tokenize(part.substr(0, part.size() - 1));
+            if (!words.empty())
+                q.prefixes.push_back(words[0]);
+        } else {
+            for (auto &w : tokenize(part))
+                q.terms.push_back(w);
+        }
+    }
+    return q;
+}
+
+// --------------------------------------------------
+// Search Index (one per group)
+// --------------------------------------------------
+// Message ids are positions in the group's history vector.
+class SearchIndex {
+private:
+    std::map<std::string, PostingList> terms;   // ordered for prefix scans
+    std::unordered_map<uint32_t, PostingList> senders;
+    uint32_t next_id = 0;
+
+public:
+    void add(const Message &msg) {
+        uint32_t id = next_id++;
+        for (auto &word : tokenize(msg.text))
+            terms[word].add(id);
+        senders[msg.sender].add(id);
+    }
+
+    // One page of matching ids, newest first. Filters are intersected by
+    // leapfrogging their cursors downwards, so the walk stops as soon as
+    // the page (plus one match to set `more`) is found.
+    std::vector<uint32_t> search(const SearchQuery &q, size_t page_size,
+                                 bool &more) const {
+        std::vector<uint32_t> out;
+        std::vector<UnionCursor> filters;
+        more = false;
+
+        for (auto &t : q.terms) {
+            auto it = terms.find(t);
+            if (it == terms.end())
+                return out;
+            filters.emplace_back();
+            filters.back().add(it->second);
+        }
+        for (auto &p : q.prefixes) {
+            filters.emplace_back();
+            auto it = terms.lower_bound(p);
+            for (; it != terms.end() && it->first.compare(0, p.size(), p) == 0; ++it)
+                filters.back().add(it->second);
+        }
+        if (q.has_sender) {
+            auto it = senders.find(q.sender);
+            if (it == senders.end())
+                return out;
+            filters.emplace_back();
+            filters.back().add(it->second);
+        }
+
+        if (filters.empty())
+            return out;
+
+        size_t skip = (q.page - 1) * page_size;
+        uint32_t target = UINT32_MAX;
+
+        while (true) {
+            bool agreed = true;
+            for (auto &f : filters) {
+                f.seek(target);
+                if (!f.valid())
+                    return out;
+                if (f.id() < target) {
+                    target = f.id();
+                    agreed = false;
+                }
+            }
+            if (!agreed)
+                continue;
+
+            // Every filter is at `target`: a match
+            if (skip > 0) {
+                skip--;
+            } else if (out.size() == page_size) {
+                more = true;
+                return out;
+            } else {
+                out.push_back(target);
+            }
+
+            if (target == 0)
+                return out;
+            target--;
+        }
+    }
+};
@@ -6,6 +6,8 @@
 #include <condition_variable>
 #include <functional>
 
+// Starts threads as tasks need them, up to `max_threads`. Tasks beyond
+// that wait in the queue until a thread is free.
 class ThreadPool {
 private:
     std::vector<std::thread> workers;
@@ -14,36 +16,43 @@ private:
     std::mutex queue_mutex;
     std::condition_variable condition;
     bool stop;
+    size_t max_threads;
+    size_t idle = 0;   // threads waiting for a task
 
-public:
-    ThreadPool(size_t threads) : stop(false) {
-        for (size_t i = 0; i < threads; i++) {
-            workers.emplace_back([this] {
-                while (true) {
-                    std::function<void()> task;
-                    {
-                        std::unique_lock<std::mutex> lock(this->queue_mutex);
-
-                        this->condition.wait(lock, 
-                            [this] { return this->stop || !this->tasks.empty(); });
+    void spawn() {
+        workers.emplace_back([this] {
+            while (true) {
+                std::function<void()> task;
+                {
+                    std::unique_lock<std::mutex> lock(this->queue_mutex);
 
-                        if (this->stop && this->tasks.empty())
-                            return;
+                    this->idle++;
+                    this->condition.wait(lock, 
+                        [this] { return this->stop || !this->tasks.empty(); });
+                    this->idle--;
 
-                        task = std::move(this->tasks.front());
-                        this->tasks.pop();
-                    }
+                    if (this->stop && this->tasks.empty())
+                        return;
 
-                    task();
+                    task = std::move(this->tasks.front());
+                    this->tasks.pop();
                 }
-            });
-        }
+
+                task();
+            }
+        });
     }
 
+public:
+    ThreadPool(size_t threads) : stop(false), max_threads(threads) {}
+
     void enqueue(std::function<void()> task) {
         {
             std::unique_lock<std::mutex> lock(queue_mutex);
             tasks.push(task);
+
+            if (tasks.size() > idle && workers.size() < max_threads)
+                spawn();
         }
         condition.notify_one();
     }
@@ -0,0 +1,248 @@
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------
+// Trace Event
+// --------------------------------------------------
+struct TraceEvent {
+    uint64_t trace_id;
+    const char *name;   // string literal, never freed
+    long start_us;
+    long dur_us;        // -1 for an instant event
+};
+
+// --------------------------------------------------
+// Per-Thread Event Buffer
+// --------------------------------------------------
+// Single writer (the owning thread), read by dump() on another thread.
+// Each slot is a seqlock: the writer marks it odd while filling it in and
+// then stamps it 2 * (n + 1) for event number n. The reader only keeps an
+// event if the stamp is the one it expects before and after copying, so
+// slots that were mid-write or already overwritten are skipped. Fields
+// are relaxed atomics, which compile to plain loads and stores.
+class TraceBuffer {
+private:
+    struct Slot {
+        std::atomic<uint64_t> seq{0};
+        std::atomic<uint64_t> trace_id{0};
+        std::atomic<const char*> name{nullptr};
+        std::atomic<long> start_us{0};
+        std::atomic<long> dur_us{0};
+    };
+
+public:
+    static const size_t CAPACITY = 16384;
+
+    int tid;
+    Slot slots[CAPACITY];
+    std::atomic<uint64_t> count{0};
+
+    TraceBuffer(int id) : tid(id) {}
+
+    void record(const TraceEvent &ev) {
+        uint64_t n = count.load(std::memory_order_relaxed);
+        Slot &s = slots[n % CAPACITY];
+
+        s.seq.store(2 * n + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        s.trace_id.store(ev.trace_id, std::memory_order_relaxed);
+        s.name.store(ev.name, std::memory_order_relaxed);
+        s.start_us.store(ev.start_us, std::memory_order_relaxed);
+        s.dur_us.store(ev.dur_us, std::memory_order_relaxed);
+
+        s.seq.store(2 * n + 2, std::memory_order_release);
+        count.store(n + 1, std::memory_order_release);
+    }
+
+    // Copy event number n; false if it is being written or was overwritten
+    bool read(uint64_t n, TraceEvent &ev) const {
+        const Slot &s = slots[n % CAPACITY];
+        uint64_t expected = 2 * n + 2;
+
+        if (s.seq.load(std::memory_order_acquire) != expected)
+            return false;
+
+        ev.trace_id = s.trace_id.load(std::memory_order_relaxed);
+        ev.name = s.name.load(std::memory_order_relaxed);
+        ev.start_us = s.start_us.load(std::memory_order_relaxed);
+        ev.dur_us = s.dur_us.load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return s.seq.load(std::memory_order_relaxed) == expected;
+    }
+};
+
+// --------------------------------------------------
+// Tracer
+// --------------------------------------------------
+// Samples one packet in `sample_every` and follows it through every stage.
+// A trace id of 0 means "not sampled" and costs nothing to record.
+class Tracer {
+private:
+    uint64_t sample_every;
+    std::atomic<uint64_t> packets{0};
+    std::atomic<uint64_t> next_id{1};
+    std::chrono::steady_clock::time_point epoch;
+
+    std::mutex registry_lock;
+    std::vector<std::unique_ptr<TraceBuffer>> buffers;
+
+    TraceBuffer *local_buffer() {
+        thread_local TraceBuffer *buf = nullptr;
+        if (!buf) {
+            std::lock_guard<std::mutex> guard(registry_lock);
+            buffers.emplace_back(new TraceBuffer(buffers.size() + 1));
+            buf = buffers.back().get();
+        }
+        return buf;
+    }
+
+    static uint64_t &current() {
+        thread_local uint64_t id = 0;
+        return id;
+    }
+
+public:
+    Tracer(uint64_t every)
+        : sample_every(every), epoch(std::chrono::steady_clock::now()) {}
+
+    // New trace id for a sampled packet, 0 otherwise
+    uint64_t sample() {
+        if (sample_every == 0 ||
+            packets.fetch_add(1, std::memory_order_relaxed) % sample_every != 0)
+            return 0;
+        return next_id.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Trace id of the job running on this thread
+    void set_current(uint64_t trace_id) { current() = trace_id; }
+    uint64_t get_current() { return current(); }
+
+    long now_us() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    long to_us(std::chrono::steady_clock::time_point t) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            t - epoch).count();
+    }
+
+    void span(uint64_t trace_id, const char *name, long start_us, long end_us) {
+        if (trace_id == 0)
+            return;
+        local_buffer()->record({trace_id, name, start_us, end_us - start_us});
+    }
+
+    void instant(uint64_t trace_id, const char *name) {
+        if (trace_id == 0)
+            return;
+        local_buffer()->record({trace_id, name, now_us(), -1});
+    }
+
+    // Write every buffered event as Chrome trace JSON (opens in Perfetto).
+    // Spans of the same trace id are chained with flow events so a packet
+    // can be followed from its reader thread to the worker that ran it.
+    bool dump(const std::string &filename) {
+        struct Dumped {
+            TraceEvent ev;
+            int tid;
+        };
+        std::vector<Dumped> events;
+
+        {
+            std::lock_guard<std::mutex> guard(registry_lock);
+            for (auto &buf : buffers) {
+                uint64_t n = buf->count.load(std::memory_order_acquire);
+                uint64_t begin = n > TraceBuffer::CAPACITY ? n - TraceBuffer::CAPACITY : 0;
+
+                TraceEvent ev;
+                for (uint64_t i = begin; i < n; i++)
+                    if (buf->read(i, ev))
+                        events.push_back({ev, buf->tid});
+            }
+        }
+
+        std::ofstream out(filename);
+        if (!out.is_open())
+            return false;
+
+        out << "{\"traceEvents\":[\n";
+        bool first = true;
+
+        for (auto &d : events) {
+            out << (first ? "" : ",\n");
+            first = false;
+
+            out << "{\"name\":\"" << d.ev.name << "\",\"cat\":\"packet\""
+                << ",\"pid\":1,\"tid\":" << d.tid
+                << ",\"ts\":" << d.ev.start_us;
+            if (d.ev.dur_us < 0)
+                out << ",\"ph\":\"i\",\"s\":\"t\"";
+            else
+                out << ",\"ph\":\"X\",\"dur\":" << d.ev.dur_us;
+            out << ",\"args\":{\"trace_id\":" << d.ev.trace_id << "}}";
+        }
+
+        // Flow: s on the first span of a trace, t on the middle ones, f on
+        // the last. Each binds to the span it sits inside.
+        std::stable_sort(events.begin(), events.end(),
+                         [](const Dumped &a, const Dumped &b) {
+                             if (a.ev.trace_id != b.ev.trace_id)
+                                 return a.ev.trace_id < b.ev.trace_id;
+                             return a.ev.start_us < b.ev.start_us;
+                         });
+        events.erase(std::remove_if(events.begin(), events.end(),
+                                    [](const Dumped &d) { return d.ev.dur_us < 0; }),
+                     events.end());
+
+        for (size_t i = 0; i < events.size(); i++) {
+            uint64_t id = events[i].ev.trace_id;
+            bool starts = i == 0 || events[i - 1].ev.trace_id != id;
+            bool ends = i + 1 == events.size() || events[i + 1].ev.trace_id != id;
+            if (starts && ends)
+                continue;  // single span, nothing to link
+
+            const char *ph = starts ? "s" : (ends ? "f" : "t");
+            out << ",\n{\"name\":\"packet\",\"cat\":\"flow\",\"ph\":\"" << ph << "\""
+                << ",\"id\":" << id
+                << ",\"pid\":1,\"tid\":" << events[i].tid
+                << ",\"ts\":" << events[i].ev.start_us;
+            if (ends)
+                out << ",\"bp\":\"e\"";
+            out << "}";
+        }
+
+        out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+        return (bool)out;
+    }
+};
+
+// --------------------------------------------------
+// Scoped Span
+// --------------------------------------------------
+// Records [construction, destruction) under the given trace id.
+class TraceScope {
+private:
+    Tracer &tracer;
+    uint64_t trace_id;
+    const char *name;
+    long start_us;
+
+public:
+    TraceScope(Tracer &t, uint64_t id, const char *n)
+        : tracer(t), trace_id(id), name(n),
+          start_us(id ? t.now_us() : 0) {}
+
+    ~TraceScope() {
+        if (trace_id)
+            tracer.span(trace_id, name, start_us, tracer.now_us());
+    }
+};
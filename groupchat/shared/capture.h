@@ -0,0 +1,35 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <cstdint>
+#include "protocol.h"
+
+// --------------------------------------------------
+// Traffic Capture File Format
+// --------------------------------------------------
+// File:   CaptureFileHeader, then CaptureRecord entries until EOF.
+// Record: fixed header followed by `size` bytes of the raw packet
+//         (header + payload_len bytes, the unused payload tail is not
+//         stored). size == 0 marks the connection closing.
+#define CAPTURE_MAGIC "GCCAP"
+#define CAPTURE_VERSION 1
+
+#pragma pack(push, 1)
+struct CaptureFileHeader {
+    char magic[5];
+    uint8_t version;           // CAPTURE_VERSION
+    uint8_t protocol_version;  // PROTOCOL_VERSION of the captured packets
+};
+
+struct CaptureRecord {
+    uint64_t time_us;    // since capture start
+    uint32_t conn_id;    // server-assigned, unique per connection
+    uint32_t group_id;   // copied from the packet for quick filtering
+    uint16_t size;       // bytes of packet data that follow
+};
+#pragma pack(pop)
+
+static_assert(sizeof(CaptureFileHeader) == 7, "bad capture layout");
+static_assert(sizeof(CaptureRecord) == 18, "bad capture layout");
+
+#endif
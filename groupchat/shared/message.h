@@ -3,10 +3,12 @@
 
 #include <string>
 #include <ctime>
+#include <cstdint>
 
 struct Message {
     uint32_t sender;
     uint32_t group;
+    uint32_t seq;        // per-group, starts at 1
     std::string text;
     time_t timestamp;
 };
@@ -3,8 +3,11 @@
 
 #include <cstdint>
 #include <cstring>
+#include <cstddef>
+#include <string_view>
+#include <type_traits>
 
-#define PROTOCOL_VERSION 1
+#define PROTOCOL_VERSION 2
 #define MAX_PAYLOAD_SIZE 256
 
 // --------------------------------------------------
@@ -17,6 +20,8 @@ enum PacketType {
     MSG_LEAVE = 4,
     SERVER_BROADCAST = 5,
     SERVER_SYSTEM = 6,
+    MSG_SEARCH = 7,
+    MSG_RESUME = 8,
 };
 
 // --------------------------------------------------
@@ -27,6 +32,7 @@ struct Packet {
     uint16_t type;            // type of packet
     uint32_t sender_id;       // sender
     uint32_t group_id;        // group or room
+    uint32_t seq;             // per-group message sequence (0 = none)
     uint16_t payload_len;     // length of payload data
     uint8_t checksum;         // XOR checksum for validation
     char payload[MAX_PAYLOAD_SIZE];
@@ -36,12 +42,59 @@ struct Packet {
         type = 0;
         sender_id = 0;
         group_id = 0;
+        seq = 0;
         payload_len = 0;
         checksum = 0;
         memset(payload, 0, sizeof(payload));
     }
 };
 
+// --------------------------------------------------
+// Wire Layout Checks
+// --------------------------------------------------
+// Packets go over the socket as raw bytes, so the layout is part of the
+// protocol. Any change here must bump PROTOCOL_VERSION.
+static_assert(std::is_trivially_copyable<Packet>::value,
+              "Packet must be sent as raw bytes");
+static_assert(std::is_standard_layout<Packet>::value,
+              "Packet must have a fixed field layout");
+static_assert(offsetof(Packet, version) == 0, "bad Packet layout");
+static_assert(offsetof(Packet, type) == 2, "bad Packet layout");
+static_assert(offsetof(Packet, sender_id) == 4, "bad Packet layout");
+static_assert(offsetof(Packet, group_id) == 8, "bad Packet layout");
+static_assert(offsetof(Packet, seq) == 12, "bad Packet layout");
+static_assert(offsetof(Packet, payload_len) == 16, "bad Packet layout");
+static_assert(offsetof(Packet, checksum) == 18, "bad Packet layout");
+static_assert(offsetof(Packet, payload) == 19, "bad Packet layout");
+static_assert(sizeof(Packet) == 276, "bad Packet layout");
+
+constexpr size_t PACKET_HEADER_SIZE = offsetof(Packet, payload);
+
+// --------------------------------------------------
+// Packet View
+// --------------------------------------------------
+// Non-owning, read-only access to a received packet. The packet must
+// outlive the view.
+class PacketView {
+private:
+    const Packet *pkt;
+
+public:
+    explicit PacketView(const Packet &p) : pkt(&p) {}
+
+    uint16_t type() const { return pkt->type; }
+    uint32_t sender_id() const { return pkt->sender_id; }
+    uint32_t group_id() const { return pkt->group_id; }
+    uint32_t seq() const { return pkt->seq; }
+
+    // Payload text, bounded by payload_len and the buffer size
+    std::string_view text() const {
+        size_t max = pkt->payload_len < MAX_PAYLOAD_SIZE
+                         ? pkt->payload_len : MAX_PAYLOAD_SIZE;
+        return std::string_view(pkt->payload, strnlen(pkt->payload, max));
+    }
+};
+
 // --------------------------------------------------
 // Checksum Creation
 // --------------------------------------------------
@@ -52,6 +105,7 @@ inline uint8_t compute_checksum(const Packet &pkt) {
     sum ^= (pkt.type >> 8) & 0xFF;
     sum ^= pkt.sender_id;
     sum ^= pkt.group_id;
+    sum ^= pkt.seq;
     sum ^= pkt.payload_len;
     for (int i = 0; i < pkt.payload_len; i++) {
         sum ^= pkt.payload[i];